@@ -0,0 +1,153 @@
+#ifndef JUMPPOINTERLCA_HPP
+#define JUMPPOINTERLCA_HPP
+
+#include <vector>
+#include <cstddef>
+#include <utility>
+#include <stdexcept>
+#include <string>
+#include <limits>
+#include <cstdint>
+#include "Tree.hpp"
+#include "NodeIndex.hpp"
+
+// LCA engine without an Euler tour: O(n) construction from a single DFS and O(log n)
+// queries over skew-binary jump pointers (Myers). Every node stores its parent and one
+// jump pointer whose length depends only on the node's depth, so two nodes at the same
+// depth jump in lockstep. Cheaper to build than LCA and about as small as a compact LCA,
+// so it suits trees that only see a few queries.
+template<typename T>
+class JumpPointerLCA {
+    public:
+        JumpPointerLCA(const Tree<T>* tree) : root(tree) {
+            const size_t size = root -> size();
+
+            if(NodeIndex<T>::capacityFor(size, true) > std::numeric_limits<uint32_t>::max()) {
+                throw std::runtime_error("Tree of " + std::to_string(size) + " nodes is too large for JumpPointerLCA");
+            }
+
+            // Nodes are identified by their slot in index, as in LCA.
+            index = NodeIndex<T>(size, true);
+            nodes = std::vector<Node>(index.capacity());
+
+            const uint32_t rootSlot = index.insert(root);
+            nodes[rootSlot] = Node(rootSlot, rootSlot, 0);
+
+            // Iterative DFS: a node is always reached after its parent.
+            std::vector<std::pair<const Tree<T>*, uint32_t>> stack;
+            pushChildren(stack, root, rootSlot);
+
+            while(!stack.empty()) {
+                const Tree<T>* tree = stack.back().first;
+                const uint32_t parent = stack.back().second;
+                stack.pop_back();
+
+                const uint32_t slot = index.insert(tree);
+                const uint32_t depth = nodes[parent].depth;
+                const uint32_t parentJump = nodes[parent].jump;
+                const uint32_t jumpLength = depth - nodes[parentJump].depth;
+                const uint32_t nextJumpLength = nodes[parentJump].depth - nodes[nodes[parentJump].jump].depth;
+
+                // Two equal jumps above the parent merge into one twice as long.
+                const uint32_t jump = jumpLength == nextJumpLength ? nodes[parentJump].jump : parent;
+                nodes[slot] = Node(parent, jump, depth + 1);
+
+                pushChildren(stack, tree, slot);
+            }
+        }
+
+        const Tree<T>* getLCA(const Tree<T>* u, const Tree<T>* v) const {
+            size_t a = requireId(u, v);
+            size_t b = requireId(v, u);
+
+            if(nodes[a].depth > nodes[b].depth) {
+                a = ancestorAtDepth(a, nodes[b].depth);
+            } else {
+                b = ancestorAtDepth(b, nodes[a].depth);
+            }
+
+            while(a != b) {
+                if(nodes[a].jump != nodes[b].jump) {
+                    a = nodes[a].jump;
+                    b = nodes[b].jump;
+                } else {
+                    a = nodes[a].parent;
+                    b = nodes[b].parent;
+                }
+            }
+
+            return index.nodeAt(a);
+        }
+
+        // Ancestor of u at the given depth (the root has depth 0).
+        const Tree<T>* getLevelAncestor(const Tree<T>* u, size_t depth) const {
+            const size_t id = requireId(u, u);
+
+            if(depth > nodes[id].depth) {
+                throw std::runtime_error("Level ancestor deeper than the node!");
+            }
+
+            return index.nodeAt(ancestorAtDepth(id, depth));
+        }
+
+        size_t getDepth(const Tree<T>* u) const {
+            return nodes[requireId(u, u)].depth;
+        }
+
+        // Bytes held by the index, excluding the tree itself.
+        size_t memoryUsage() const {
+            return nodes.capacity() * sizeof(Node) + index.memoryUsage();
+        }
+
+    private:
+        // Parent, jump target and depth of the node in the same slot of index.
+        struct Node {
+            uint32_t parent;
+            uint32_t jump;
+            uint32_t depth;
+
+            Node() : parent(0), jump(0), depth(0) {}
+            Node(uint32_t _parent, uint32_t _jump, uint32_t _depth)
+                : parent(_parent), jump(_jump), depth(_depth) {}
+        };
+
+        const Tree<T>* root;
+        NodeIndex<T> index;
+        std::vector<Node> nodes;
+
+        static void pushChildren(std::vector<std::pair<const Tree<T>*, uint32_t>>& stack, const Tree<T>* tree, uint32_t slot) {
+            for(const Tree<T>* child : tree -> children()) {
+                stack.push_back(std::make_pair(child, slot));
+            }
+        }
+
+        size_t ancestorAtDepth(size_t id, size_t depth) const {
+            while(nodes[id].depth > depth) {
+                if(nodes[nodes[id].jump].depth >= depth) {
+                    id = nodes[id].jump;
+                } else {
+                    id = nodes[id].parent;
+                }
+            }
+
+            return id;
+        }
+
+        // Id of a query node; other is the second node of the same query.
+        size_t requireId(const Tree<T>* node, const Tree<T>* other) const {
+            if(node == nullptr || other == nullptr) {
+                throw std::runtime_error("Nullptr passed as argument!");
+            }
+
+            const size_t slot = index.find(node);
+
+            // Like LCA, without printing the tree: operator<< recurses as deep as the tree.
+            if(slot == NodeIndex<T>::NOT_FOUND) {
+                throw std::runtime_error("Node not found in this tree!");
+            }
+
+            return slot;
+        }
+};
+
+#endif
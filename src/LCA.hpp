@@ -2,80 +2,269 @@
 #define LCA_HPP
 
 #include <utility>
-#include <sstream>
+#include <stdexcept>
+#include <limits>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
 #include "Tree.hpp"
+#include "NodeIndex.hpp"
 #include "PlusMinusOneRMQ.hpp"
 
 template<typename T>
 class LCA {
     public:
-        LCA(const Tree<T>* tree) : root(tree) {
-            const size_t size = root -> size();
+        static const size_t UNLIMITED_MEMORY = std::numeric_limits<size_t>::max();
 
-            E.resize(2*size - 1);
-            std::vector<size_t> D(2*size - 1);
+        // If the full index does not fit in memoryBudget bytes, a compact one is built instead:
+        // the node index is filled tighter, depths are not copied and the RMQ sparse table is
+        // sampled every superblockSize() blocks, the smallest power of two that fits the budget.
+        // The budget covers the peak of construction, including the traversal stack.
+        LCA(const Tree<T>* tree, size_t memoryBudget = UNLIMITED_MEMORY) : root(tree), compact(false) {
+            size_t size, height;
+            measure(size, height);
 
-            size_t index = 0;
-            EulerTraversal(root, E, D, 0, index);
+            if(2*size - 1 > std::numeric_limits<uint32_t>::max()) {
+                throw std::runtime_error("Tree of " + std::to_string(size) + " nodes is too large for LCA");
+            }
+
+            size_t superblock = 1;
+
+            if(estimatePeakMemoryUsage(size, height, superblock, false) > memoryBudget) {
+                compact = true;
 
-            RMQ = PlusMinusOneRMQ(D);
+                while(estimatePeakMemoryUsage(size, height, superblock, true) > memoryBudget) {
+                    if(superblock >= PlusMinusOneRMQ::blockCount(2*size - 1)) {
+                        throw std::runtime_error("Memory budget of " + std::to_string(memoryBudget)
+                            + " bytes is too small for a tree of " + std::to_string(size) + " nodes");
+                    }
+                    superblock <<= 1;
+                }
+            }
+
+            nodes = NodeIndex<T>(size, compact);
+            firstOccurrence = std::vector<uint32_t>(nodes.capacity());
+            E.reserve(2*size - 1);
+            RMQ = PlusMinusOneRMQ(2*size - 1, superblock, compact);
+
+            EulerTraversal(height);
+
+            RMQ.finish();
         }
 
         const Tree<T>* getLCA(const Tree<T>* u, const Tree<T>* v) const {
-            if(u == nullptr || v == nullptr) {
-                throw std::runtime_error("Nullptr passed as argument!");
+            return eulerNode(RMQ.getRMQ(requireEdgeIndex(u, v), requireEdgeIndex(v, u)));
+        }
+
+        // Batched getLCA. Each stage of a query (finding both nodes in the index, reading
+        // their first occurrences, the range minimum, reading the node back from the tour)
+        // is a dependent cache miss, so queries go through every stage in groups, prefetching
+        // what the next stage needs for the whole group before using any of it.
+        std::vector<const Tree<T>*> getLCAs(const std::vector<std::pair<const Tree<T>*, const Tree<T>*>>& queries) const {
+            const size_t group = PlusMinusOneRMQ::INTERLEAVED_QUERIES;
+            std::vector<std::pair<size_t, size_t>> indices(queries.size());
+
+            for(size_t first = 0; first < queries.size(); first += group) {
+                const size_t last = queries.size() - first < group ? queries.size() : first + group;
+
+                for(size_t q = first; q < last; q++) {
+                    if(queries[q].first == nullptr || queries[q].second == nullptr) {
+                        throw std::runtime_error("Nullptr passed as argument!");
+                    }
+
+                    nodes.prefetch(queries[q].first);
+                    nodes.prefetch(queries[q].second);
+                }
+
+                for(size_t q = first; q < last; q++) {
+                    indices[q].first = nodes.find(queries[q].first);
+                    indices[q].second = nodes.find(queries[q].second);
+
+                    if(indices[q].first == NodeIndex<T>::NOT_FOUND || indices[q].second == NodeIndex<T>::NOT_FOUND) {
+                        throw nodeNotFound();
+                    }
+
+                    __builtin_prefetch(&firstOccurrence[indices[q].first]);
+                    __builtin_prefetch(&firstOccurrence[indices[q].second]);
+                }
+
+                for(size_t q = first; q < last; q++) {
+                    indices[q].first = firstOccurrence[indices[q].first];
+                    indices[q].second = firstOccurrence[indices[q].second];
+                }
             }
 
-            const size_t indexU = getEdgeIndex(u);
-            const size_t indexV = getEdgeIndex(v);
+            std::vector<size_t> minimums;
+            RMQ.getRMQs(indices, minimums);
+
+            std::vector<const Tree<T>*> result(queries.size());
+
+            for(size_t first = 0; first < minimums.size(); first += group) {
+                const size_t last = minimums.size() - first < group ? minimums.size() : first + group;
+
+                for(size_t q = first; q < last; q++) {
+                    __builtin_prefetch(&E[minimums[q]]);
+                }
+
+                for(size_t q = first; q < last; q++) {
+                    minimums[q] = E[minimums[q]];
+                    nodes.prefetchSlot(minimums[q]);
+                }
 
-            if(indexU == E.size() || indexV == E.size()) {
-                std::ostringstream ostr;
-                ostr << *root;
-                throw std::runtime_error("Node not found in this tree: " + ostr.str());
+                for(size_t q = first; q < last; q++) {
+                    result[q] = nodes.nodeAt(minimums[q]);
+                }
             }
 
-            return E[RMQ.getRMQ(indexU, indexV)];
+            return result;
+        }
+
+        bool isCompact() const {
+            return compact;
+        }
+
+        size_t superblockSize() const {
+            return RMQ.superblockSize();
         }
 
-    private:
+        // Bytes held by the index, excluding the tree itself.
+        size_t memoryUsage() const {
+            return E.capacity() * sizeof(uint32_t)
+                + nodes.memoryUsage()
+                + firstOccurrence.capacity() * sizeof(uint32_t)
+                + RMQ.memoryUsage();
+        }
+
+        // memoryUsage() of an LCA over a tree with the given number of nodes.
+        static size_t estimateMemoryUsage(size_t size, size_t superblock = 1, bool compact = false) {
+            const size_t eulerSize = 2*size - 1;
+
+            return eulerSize * sizeof(uint32_t)
+                + NodeIndex<T>::estimateMemoryUsage(size, compact)
+                + NodeIndex<T>::capacityFor(size, compact) * sizeof(uint32_t)
+                + PlusMinusOneRMQ::estimateMemoryUsage(eulerSize, superblock, compact);
+        }
+
+        // Most memory held while building that index over a tree of the given height (the
+        // root alone has height 0): the finished index plus the traversal stack.
+        static size_t estimatePeakMemoryUsage(size_t size, size_t height, size_t superblock = 1, bool compact = false) {
+            return estimateMemoryUsage(size, superblock, compact) + (height + 1) * sizeof(PathEntry);
+        }
+
+    protected:
+        typedef typename std::list<Tree<T>*>::const_iterator ChildIterator;
+
+        // A node on the way from the root, its next child to descend into and its slot in nodes.
+        struct PathEntry {
+            const Tree<T>* tree;
+            ChildIterator next;
+            uint32_t slot;
+
+            PathEntry(const Tree<T>* _tree, uint32_t _slot)
+                : tree(_tree), next(_tree -> children().begin()), slot(_slot) {}
+        };
+
         const Tree<T>* root;
-        std::vector<const Tree<T>*> E;
+        bool compact;
+        // Every node gets the id of its slot in nodes; E is the Euler tour as node ids and
+        // firstOccurrence the first index of every id in E.
+        NodeIndex<T> nodes;
+        std::vector<uint32_t> E;
+        std::vector<uint32_t> firstOccurrence;
         PlusMinusOneRMQ RMQ;
 
-        void EulerTraversal(
-            const Tree<T>* tree, 
-            std::vector<const Tree<T>*>& edges, 
-            std::vector<size_t>& depths,
-            const size_t depth,
-            size_t& index) {
-
-            edges[index] = tree;
-            depths[index] = depth;
-
-            const std::list<Tree<T>*>& children = tree -> children();
-            for(const Tree<T>* child : children) {
-                index++;
-                EulerTraversal(child, edges, depths, depth + 1, index);
-                index++;
-                edges[index] = tree;
-                depths[index] = depth;
+        const Tree<T>* eulerNode(size_t index) const {
+            return nodes.nodeAt(E[index]);
+        }
+
+        // Number of nodes and height of the tree, walked with the same stack as EulerTraversal.
+        void measure(size_t& size, size_t& height) const {
+            std::vector<PathEntry> path;
+            path.push_back(PathEntry(root, 0));
+            size = 1;
+            height = 0;
+
+            while(!path.empty()) {
+                if(path.back().next == path.back().tree -> children().end()) {
+                    path.pop_back();
+                    continue;
+                }
+
+                const Tree<T>* child = *path.back().next;
+                ++path.back().next;
+
+                size++;
+                height = std::max(height, path.size());
+                path.push_back(PathEntry(child, 0));
             }
         }
 
-        size_t getEdgeIndex(const Tree<T>* edge) const {
-            const size_t size = E.size();
-            size_t edgeIndex = size;
+        // Iterative, so that deep trees do not overflow the call stack. The depths go straight
+        // into the RMQ instead of through a temporary array.
+        void EulerTraversal(size_t height) {
+            std::vector<PathEntry> path;
+            path.reserve(height + 1);
+
+            visit(nodes.insert(root), 0);
+            path.push_back(PathEntry(root, E.back()));
 
-            for(size_t i = 0; i < size; i++) {
-                if(E[i] == edge) {
-                    edgeIndex = i;
-                    break;
+            while(!path.empty()) {
+                if(path.back().next == path.back().tree -> children().end()) {
+                    path.pop_back();
+                    if(!path.empty()) {
+                        E.push_back(path.back().slot);
+                        RMQ.push(path.size() - 1);
+                    }
+                    continue;
                 }
+
+                const Tree<T>* child = *path.back().next;
+                ++path.back().next;
+
+                visit(nodes.insert(child), path.size());
+                path.push_back(PathEntry(child, E.back()));
             }
+        }
 
-            return edgeIndex;
+        void visit(size_t slot, size_t depth) {
+            firstOccurrence[slot] = E.size();
+            E.push_back(slot);
+            RMQ.push(depth);
+        }
+
+        // Euler index of a query node; other is the second node of the same query.
+        size_t requireEdgeIndex(const Tree<T>* node, const Tree<T>* other) const {
+            if(node == nullptr || other == nullptr) {
+                throw std::runtime_error("Nullptr passed as argument!");
+            }
+
+            const size_t index = getEdgeIndex(node);
+
+            if(index == E.size()) {
+                throw nodeNotFound();
+            }
+
+            return index;
+        }
+
+        // The tree is not printed into the message: that would take O(n) bytes and a
+        // recursion as deep as the tree.
+        static std::runtime_error nodeNotFound() {
+            return std::runtime_error("Node not found in this tree!");
+        }
+
+        size_t getEdgeIndex(const Tree<T>* edge) const {
+            const size_t slot = nodes.find(edge);
+
+            if(slot == NodeIndex<T>::NOT_FOUND) {
+                return E.size();
+            }
+
+            return firstOccurrence[slot];
         }
 };
 
+template<typename T>
+const size_t LCA<T>::UNLIMITED_MEMORY;
+
 #endif
\ No newline at end of file
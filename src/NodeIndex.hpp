@@ -0,0 +1,97 @@
+#ifndef NODEINDEX_HPP
+#define NODEINDEX_HPP
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "Tree.hpp"
+
+// Flat open-addressing set of the nodes of a tree. The slot a node lands in is its id:
+// callers keep per-node data in arrays of capacity() entries indexed by slot, and get the
+// node back with nodeAt(). Finding a node is a short linear probe inside one or two cache
+// lines.
+template<typename T>
+class NodeIndex {
+    public:
+        static const size_t NOT_FOUND = static_cast<size_t>(-1);
+
+        NodeIndex() {}
+        // A compact index is filled to 4/5 instead of 2/3, trading longer probes for memory.
+        NodeIndex(size_t size, bool compact = false) : slots(capacityFor(size, compact), nullptr) {}
+
+        size_t insert(const Tree<T>* node) {
+            size_t slot = home(node);
+
+            while(slots[slot] != nullptr && slots[slot] != node) {
+                slot = next(slot);
+            }
+
+            slots[slot] = node;
+            return slot;
+        }
+
+        size_t find(const Tree<T>* node) const {
+            if(slots.empty() || node == nullptr) {
+                return NOT_FOUND;
+            }
+
+            size_t slot = home(node);
+
+            while(slots[slot] != nullptr) {
+                if(slots[slot] == node) {
+                    return slot;
+                }
+                slot = next(slot);
+            }
+
+            return NOT_FOUND;
+        }
+
+        // Starts loading the slot where the search for node begins.
+        void prefetch(const Tree<T>* node) const {
+            if(!slots.empty()) {
+                __builtin_prefetch(&slots[home(node)]);
+            }
+        }
+
+        void prefetchSlot(size_t slot) const {
+            __builtin_prefetch(&slots[slot]);
+        }
+
+        const Tree<T>* nodeAt(size_t slot) const {
+            return slots[slot];
+        }
+
+        size_t capacity() const {
+            return slots.size();
+        }
+
+        size_t memoryUsage() const {
+            return slots.capacity() * sizeof(const Tree<T>*);
+        }
+
+        static size_t capacityFor(size_t size, bool compact = false) {
+            return compact ? size + size / 4 + 1 : size + size / 2 + 1;
+        }
+
+        static size_t estimateMemoryUsage(size_t size, bool compact = false) {
+            return capacityFor(size, compact) * sizeof(const Tree<T>*);
+        }
+
+    private:
+        std::vector<const Tree<T>*> slots;
+
+        size_t home(const Tree<T>* node) const {
+            const uint64_t hash = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(node)) * 0x9E3779B97F4A7C15ULL;
+            return static_cast<size_t>((static_cast<unsigned __int128>(hash) * slots.size()) >> 64);
+        }
+
+        size_t next(size_t slot) const {
+            return slot + 1 == slots.size() ? 0 : slot + 1;
+        }
+};
+
+template<typename T>
+const size_t NodeIndex<T>::NOT_FOUND;
+
+#endif
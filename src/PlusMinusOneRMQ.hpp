@@ -3,37 +3,54 @@
 
 #include <vector>
 #include <cstddef>
-#include <bitset>
+#include <algorithm>
+#include <utility>
+#include <limits>
+#include <string>
+#include <cstdint>
+#include <stdexcept>
 
 class PlusMinusOneRMQ {
     public:
-        PlusMinusOneRMQ() {}
-        PlusMinusOneRMQ(const std::vector<size_t> _arr) : arr(_arr) {
-            const size_t n = arr.size();
+        // Number of independent queries getRMQs() advances in lockstep.
+        static const size_t INTERLEAVED_QUERIES = 16;
 
-            const size_t log_2 = 63 - __builtin_clzll(n);
-            s = std::max<size_t>(1, log_2 >> 1);
+        PlusMinusOneRMQ() : s(1), n(0), length(0), block_size(0), superblock(1), superblock_count(0), compact(false), previous(0), superblock_minimum(0) {}
 
-            const size_t block_size = (n + s - 1) / s;
-            blocks = std::vector<size_t>(block_size);
+        // superblock > 1 keeps the sparse table only for groups of that many blocks, dividing its
+        // size by superblock while queries scan up to 2 * (superblock - 1) extra blocks.
+        // A compact structure drops the copy of _arr and rebuilds depths from the block masks.
+        PlusMinusOneRMQ(const std::vector<size_t>& _arr, size_t _superblock = 1, bool _compact = false)
+            : PlusMinusOneRMQ(_arr.size(), _superblock, _compact) {
+            for(size_t value : _arr) {
+                push(value);
+            }
+            finish();
+        }
 
-            for(size_t b = 0; b < block_size; b++){
-                size_t start = b * s;
-                size_t end = std::min(start + s, n);
+        // Starts a structure over n values that are then streamed in with push() and sealed
+        // with finish(), so the caller never has to materialize the whole sequence. Every
+        // table is allocated at its final size up front.
+        explicit PlusMinusOneRMQ(size_t _n, size_t _superblock = 1, bool _compact = false)
+            : n(_n), length(0), superblock(std::max<size_t>(1, _superblock)), compact(_compact), previous(0), superblock_minimum(0) {
+            if(n > std::numeric_limits<uint32_t>::max()) {
+                throw std::runtime_error("Sequence too long for PlusMinusOneRMQ!");
+            }
 
-                size_t mask = 0;
-                for(size_t i = start + 1; i < end; i++){
-                    if(arr[i] < arr[i - 1]) {
-                        mask |= (1ULL << (i - start - 1));
-                    }
-                }
-                blocks[b] = mask;
+            s = blockLength(n);
+            block_size = (n + s - 1) / s;
+            superblock_count = (block_size + superblock - 1) / superblock;
+
+            if(compact) {
+                block_depths.reserve(block_size);
+            } else {
+                arr.reserve(n);
             }
+            blocks.reserve(block_size);
+            block_min_sparse_table.reserve(superblock_count * sparseLevels(superblock_count));
 
             const size_t count_classes_of_equivalence = 1ULL << (s - 1);
-            normalized_block_RMQ_table = std::vector<std::vector<std::vector<size_t>>>(
-                count_classes_of_equivalence, std::vector<std::vector<size_t>>(s, std::vector<size_t>(s))
-            );
+            normalized_block_RMQ_table = std::vector<unsigned char>(count_classes_of_equivalence * s * s);
 
             std::vector<int> depth(s);
             for(size_t t = 0; t < count_classes_of_equivalence; t++){
@@ -46,7 +63,7 @@ class PlusMinusOneRMQ {
                 }
 
                 for(size_t i = 0; i < s; i++){
-                    normalized_block_RMQ_table[t][i][i] = i;
+                    normalized_block_RMQ_table[(t * s + i) * s + i] = i;
                     int minDepth = depth[i];
                     size_t minIdx = i;
 
@@ -55,39 +72,60 @@ class PlusMinusOneRMQ {
                             minDepth = depth[j];
                             minIdx = j;
                         }
-                        normalized_block_RMQ_table[t][i][j] = minIdx;
+                        normalized_block_RMQ_table[(t * s + i) * s + j] = minIdx;
                     }
                 }
             }
+        }
 
-            std::vector<size_t> blocks_minimums(block_size);
-
-            for(size_t b = 0; b < block_size; b++){
-                size_t start = b * s;
-                size_t end = std::min(start + s, n);
+        // Appends the next value of the sequence; consecutive values must differ by one.
+        void push(size_t value) {
+            const size_t index = length++;
+            const size_t r = index % s;
 
-                size_t minIdx = start;
-                for(size_t i = start + 1; i < end; i++){
-                    if(arr[i] < arr[minIdx])
-                        minIdx = i;
+            if(r == 0) {
+                blocks.push_back(0);
+                if(compact) {
+                    block_depths.push_back(value);
                 }
-                blocks_minimums[b] = minIdx;
+            } else if(value < previous) {
+                blocks.back() |= 1U << (r - 1);
             }
 
-            const size_t log_2_block_size = 63 - __builtin_clzll(block_size);
-            block_min_sparse_table = std::vector<std::vector<size_t>>(block_size, std::vector<size_t>(log_2_block_size + 1));
+            if(!compact) {
+                arr.push_back(value);
+            }
 
-            for(size_t i = 0; i < block_size; i++) {
-                block_min_sparse_table[i][0] = blocks_minimums[i];
-            
+            // The first level of the sparse table is filled as the superblocks go by.
+            if(index % (superblock * s) == 0) {
+                block_min_sparse_table.push_back(index);
+                superblock_minimum = value;
+            } else if(value < superblock_minimum) {
+                block_min_sparse_table.back() = index;
+                superblock_minimum = value;
             }
 
-            for(size_t j = 1; j <= log_2_block_size; j++){
-                for(size_t i = 0; i + (1ULL << j) <= block_size; i++){
-                    if(arr[block_min_sparse_table[i][j - 1]] <= arr[block_min_sparse_table[i + (1ULL << (j - 1))][j - 1]]) {
-                        block_min_sparse_table[i][j] = block_min_sparse_table[i][j - 1];
+            previous = value;
+        }
+
+        // Builds the upper levels of the sparse table once all n values have been pushed.
+        void finish() {
+            if(length != n) {
+                throw std::runtime_error("PlusMinusOneRMQ expected " + std::to_string(n) + " values, got " + std::to_string(length) + "!");
+            }
+
+            const size_t levels = sparseLevels(superblock_count);
+            block_min_sparse_table.resize(superblock_count * levels);
+
+            for(size_t j = 1; j < levels; j++){
+                const uint32_t* previous_level = &block_min_sparse_table[(j - 1) * superblock_count];
+                uint32_t* current = &block_min_sparse_table[j * superblock_count];
+
+                for(size_t i = 0; i + (1ULL << j) <= superblock_count; i++){
+                    if(depthAt(previous_level[i]) <= depthAt(previous_level[i + (1ULL << (j - 1))])) {
+                        current[i] = previous_level[i];
                     } else {
-                        block_min_sparse_table[i][j] = block_min_sparse_table[i + (1ULL << (j - 1))][j - 1];
+                        current[i] = previous_level[i + (1ULL << (j - 1))];
                     }
                 }
             }
@@ -104,33 +142,20 @@ class PlusMinusOneRMQ {
             size_t b2 = j / s;
 
             if(b1 == b2){
-                size_t t = blocks[b1];
-                size_t i = i % s;
-                size_t j = j % s;
-                return b1 * s + normalized_block_RMQ_table[t][i][j];
+                return b1 * s + normalizedRMQ(blocks[b1], i % s, j % s);
             }
 
-            size_t t1 = blocks[b1];
-            size_t i1 = i % s;
-            size_t block_end_index = std::min(s - 1, arr.size() - b1 * s - 1);
-            size_t min_index = b1 * s + normalized_block_RMQ_table[t1][i1][block_end_index];
+            size_t min_index = b1 * s + normalizedRMQ(blocks[b1], i % s, blockEnd(b1));
 
-            size_t t2 = blocks[b2];
-            size_t j2 = j % s;
-            size_t prefix_min_index = b2 * s + normalized_block_RMQ_table[t2][0][j2];
-            if(arr[prefix_min_index] < arr[min_index]) {
+            size_t prefix_min_index = b2 * s + normalizedRMQ(blocks[b2], 0, j % s);
+            if(depthAt(prefix_min_index) < depthAt(min_index)) {
                 min_index = prefix_min_index;
             }
 
             if(b1 + 1 <= b2 - 1){
-                const size_t interval_length =  b2 - b1 - 1;
-                const size_t k = 63 - __builtin_clzll(interval_length);
-
-                const size_t x = block_min_sparse_table[b1+1][k];
-                const size_t y = block_min_sparse_table[b2-1 - (1ULL << k) + 1][k];
-                size_t mid = (arr[x] <= arr[y]) ? x : y;
+                size_t mid = blockRangeMin(b1 + 1, b2 - 1);
 
-                if(arr[mid] < arr[min_index]) {
+                if(depthAt(mid) < depthAt(min_index)) {
                     min_index = mid;
                 }
             }
@@ -138,12 +163,251 @@ class PlusMinusOneRMQ {
             return min_index;
         }
 
+        // Answers a batch of independent queries. Every query is a chain of dependent
+        // loads (block mask, normalized table, sparse table, depths), so instead of
+        // waiting on each one in turn the batch is processed in groups whose queries
+        // advance stage by stage, prefetching what the next stage needs.
+        void getRMQs(const std::vector<std::pair<size_t, size_t>>& queries, std::vector<size_t>& results) const {
+            results.resize(queries.size());
+
+            PendingQuery lanes[INTERLEAVED_QUERIES];
+
+            for(size_t first = 0; first < queries.size(); first += INTERLEAVED_QUERIES) {
+                const size_t remaining = queries.size() - first;
+                const size_t count = remaining < INTERLEAVED_QUERIES ? remaining : INTERLEAVED_QUERIES;
+
+                for(size_t l = 0; l < count; l++) {
+                    PendingQuery& q = lanes[l];
+                    q.i = std::min(queries[first + l].first, queries[first + l].second);
+                    q.j = std::max(queries[first + l].first, queries[first + l].second);
+                    q.b1 = q.i / s;
+                    q.b2 = q.j / s;
+
+                    __builtin_prefetch(&blocks[q.b1]);
+                    __builtin_prefetch(&blocks[q.b2]);
+
+                    if(superblock == 1 && q.b1 + 1 < q.b2) {
+                        q.k = 63 - __builtin_clzll(q.b2 - q.b1 - 1);
+                        __builtin_prefetch(&block_min_sparse_table[q.k * superblock_count + q.b1 + 1]);
+                        __builtin_prefetch(&block_min_sparse_table[q.k * superblock_count + q.b2 - (1ULL << q.k)]);
+                    }
+                }
+
+                for(size_t l = 0; l < count; l++) {
+                    PendingQuery& q = lanes[l];
+                    q.t1 = blocks[q.b1];
+                    q.t2 = blocks[q.b2];
+
+                    __builtin_prefetch(&normalized_block_RMQ_table[(q.t1 * s + q.i % s) * s]);
+                    if(q.b1 != q.b2) {
+                        __builtin_prefetch(&normalized_block_RMQ_table[q.t2 * s * s]);
+                    }
+                }
+
+                for(size_t l = 0; l < count; l++) {
+                    PendingQuery& q = lanes[l];
+
+                    if(q.b1 == q.b2) {
+                        q.candidates[0] = q.b1 * s + normalizedRMQ(q.t1, q.i % s, q.j % s);
+                        q.count = 1;
+                        continue;
+                    }
+
+                    q.candidates[0] = q.b1 * s + normalizedRMQ(q.t1, q.i % s, blockEnd(q.b1));
+                    q.candidates[1] = q.b2 * s + normalizedRMQ(q.t2, 0, q.j % s);
+                    q.count = 2;
+
+                    if(q.b1 + 1 < q.b2) {
+                        if(superblock == 1) {
+                            q.candidates[2] = sparseMin(q.k, q.b1 + 1);
+                            q.candidates[3] = sparseMin(q.k, q.b2 - (1ULL << q.k));
+                            q.count = 4;
+                        } else {
+                            q.candidates[2] = blockRangeMin(q.b1 + 1, q.b2 - 1);
+                            q.count = 3;
+                        }
+                    }
+
+                    for(size_t c = 0; c < q.count; c++) {
+                        prefetchDepth(q.candidates[c]);
+                    }
+                }
+
+                for(size_t l = 0; l < count; l++) {
+                    const PendingQuery& q = lanes[l];
+
+                    size_t min_index = q.candidates[0];
+                    for(size_t c = 1; c < q.count; c++) {
+                        if(depthAt(q.candidates[c]) < depthAt(min_index)) {
+                            min_index = q.candidates[c];
+                        }
+                    }
+                    results[first + l] = min_index;
+                }
+            }
+        }
+
+        size_t valueAt(size_t index) const {
+            return depthAt(index);
+        }
+
+        size_t superblockSize() const {
+            return superblock;
+        }
+
+        // Bytes held by the structure's tables.
+        size_t memoryUsage() const {
+            return arr.capacity() * sizeof(size_t)
+                + blocks.capacity() * sizeof(uint32_t)
+                + block_depths.capacity() * sizeof(size_t)
+                + block_min_sparse_table.capacity() * sizeof(uint32_t)
+                + normalized_block_RMQ_table.capacity() * sizeof(unsigned char);
+        }
+
+        // memoryUsage() of a structure built over n values with the given parameters. A
+        // streamed build never holds more than this.
+        static size_t estimateMemoryUsage(size_t n, size_t superblock = 1, bool compact = false) {
+            const size_t s = blockLength(n);
+            const size_t block_size = (n + s - 1) / s;
+            const size_t superblock_count = (block_size + std::max<size_t>(1, superblock) - 1) / std::max<size_t>(1, superblock);
+
+            return (compact ? block_size : n) * sizeof(size_t)
+                + block_size * sizeof(uint32_t)
+                + superblock_count * sparseLevels(superblock_count) * sizeof(uint32_t)
+                + (1ULL << (s - 1)) * s * s * sizeof(unsigned char);
+        }
+
+        static size_t blockCount(size_t n) {
+            const size_t s = blockLength(n);
+            return (n + s - 1) / s;
+        }
+
     private:
+        struct PendingQuery {
+            size_t i, j;
+            size_t b1, b2;
+            size_t k;
+            size_t t1, t2;
+            size_t candidates[4];
+            size_t count;
+        };
+
         size_t s;
+        size_t n;
+        // Number of values pushed so far.
+        size_t length;
+        size_t block_size;
+        size_t superblock;
+        size_t superblock_count;
+        bool compact;
+        // Last value pushed and minimum of the current superblock, only used while building.
+        size_t previous;
+        size_t superblock_minimum;
         std::vector<size_t> arr;
-        std::vector<size_t> blocks;
-        std::vector<std::vector<size_t>> block_min_sparse_table;
-        std::vector<std::vector<std::vector<size_t>>> normalized_block_RMQ_table;
+        // Bit i - 1 of a block's mask is set when the value at offset i is a descent.
+        std::vector<uint32_t> blocks;
+        // Depth at the start of every block; only kept when arr is dropped.
+        std::vector<size_t> block_depths;
+        // Level-major: entry k * superblock_count + b is the minimum of superblocks [b, b + 2^k).
+        std::vector<uint32_t> block_min_sparse_table;
+        // Entry (t * s + i) * s + j is the in-block minimum of [i, j] for block type t.
+        std::vector<unsigned char> normalized_block_RMQ_table;
+
+        static size_t blockLength(size_t n) {
+            const size_t log_2 = 63 - __builtin_clzll(n);
+            return std::max<size_t>(1, log_2 >> 1);
+        }
+
+        static size_t sparseLevels(size_t superblock_count) {
+            return superblock_count == 0 ? 0 : 64 - __builtin_clzll(superblock_count);
+        }
+
+        size_t depthAt(size_t index) const {
+            if(!compact) {
+                return arr[index];
+            }
+
+            const size_t b = index / s;
+            const size_t r = index % s;
+            const size_t descents = __builtin_popcountll(blocks[b] & ((1ULL << r) - 1));
+
+            return block_depths[b] + r - 2 * descents;
+        }
+
+        void prefetchDepth(size_t index) const {
+            if(!compact) {
+                __builtin_prefetch(&arr[index]);
+            } else {
+                __builtin_prefetch(&blocks[index / s]);
+                __builtin_prefetch(&block_depths[index / s]);
+            }
+        }
+
+        size_t normalizedRMQ(size_t t, size_t i, size_t j) const {
+            return normalized_block_RMQ_table[(t * s + i) * s + j];
+        }
+
+        size_t sparseMin(size_t k, size_t b) const {
+            return block_min_sparse_table[k * superblock_count + b];
+        }
+
+        size_t blockEnd(size_t b) const {
+            return std::min(s - 1, n - b * s - 1);
+        }
+
+        size_t sparseRangeMin(size_t first, size_t last) const {
+            const size_t k = 63 - __builtin_clzll(last - first + 1);
+
+            const size_t x = sparseMin(k, first);
+            const size_t y = sparseMin(k, last + 1 - (1ULL << k));
+
+            return (depthAt(x) <= depthAt(y)) ? x : y;
+        }
+
+        size_t scanBlocks(size_t first, size_t last) const {
+            size_t min_index = first * s + normalizedRMQ(blocks[first], 0, blockEnd(first));
+
+            for(size_t b = first + 1; b <= last; b++) {
+                const size_t block_min_index = b * s + normalizedRMQ(blocks[b], 0, blockEnd(b));
+                if(depthAt(block_min_index) < depthAt(min_index)) {
+                    min_index = block_min_index;
+                }
+            }
+
+            return min_index;
+        }
+
+        // Minimum over the whole blocks [first, last].
+        size_t blockRangeMin(size_t first, size_t last) const {
+            if(superblock == 1) {
+                return sparseRangeMin(first, last);
+            }
+
+            const size_t first_superblock = (first + superblock - 1) / superblock;
+            const size_t end_superblock = (last + 1) / superblock;
+
+            if(first_superblock >= end_superblock) {
+                return scanBlocks(first, last);
+            }
+
+            size_t min_index = sparseRangeMin(first_superblock, end_superblock - 1);
+
+            if(first < first_superblock * superblock) {
+                const size_t left = scanBlocks(first, first_superblock * superblock - 1);
+                if(depthAt(left) < depthAt(min_index)) {
+                    min_index = left;
+                }
+            }
+
+            if(end_superblock * superblock <= last) {
+                const size_t right = scanBlocks(end_superblock * superblock, last);
+                if(depthAt(right) < depthAt(min_index)) {
+                    min_index = right;
+                }
+            }
+
+            return min_index;
+        }
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -3,6 +3,7 @@
 
 #include <iostream>
 #include <list>
+#include <vector>
 #include <cstddef>
 
 template<typename T>
@@ -72,10 +73,17 @@ class Tree {
         }
 
         size_t size() const {
-            size_t count = 1;
+            size_t count = 0;
+            std::vector<const Tree<T>*> pending(1, this);
 
-            for(const auto& child : subtrees) {
-                count += child -> size();
+            while(!pending.empty()) {
+                const Tree<T>* node = pending.back();
+                pending.pop_back();
+                count++;
+
+                for(const auto* child : node -> subtrees) {
+                    pending.push_back(child);
+                }
             }
 
             return count;
@@ -147,11 +155,20 @@ class Tree {
         T data;
         std::list<Tree<T>*> subtrees;
 
+        // Detaches every descendant before deleting it, so that destroying a deep
+        // tree does not recurse once per level.
         void erase() {
-            for(Tree<T>* node : subtrees) {
+            std::vector<Tree<T>*> pending(subtrees.begin(), subtrees.end());
+            subtrees.clear();
+
+            while(!pending.empty()) {
+                Tree<T>* node = pending.back();
+                pending.pop_back();
+
+                pending.insert(pending.end(), node -> subtrees.begin(), node -> subtrees.end());
+                node -> subtrees.clear();
                 delete node;
             }
-            subtrees.clear();
         }
 };
 
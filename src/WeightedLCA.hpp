@@ -0,0 +1,264 @@
+#ifndef WEIGHTEDLCA_HPP
+#define WEIGHTEDLCA_HPP
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include "Tree.hpp"
+#include "LCA.hpp"
+#include "PlusMinusOneRMQ.hpp"
+
+// Default edge-weight accessor: the weight of the edge from a node to its parent is value.weight().
+template<typename T>
+struct EdgeWeightOf {
+    auto operator()(const T& value) const -> decltype(value.weight()) {
+        return value.weight();
+    }
+};
+
+// LCA over a tree whose edges are weighted. The weight of the edge between a node and its
+// parent is WeightOf()(node value); the weight of the root is ignored.
+template<typename T, typename WeightOf = EdgeWeightOf<T>>
+class WeightedLCA : public LCA<T> {
+    public:
+        typedef typename std::decay<decltype(std::declval<const WeightOf&>()(std::declval<const T&>()))>::type Weight;
+
+        WeightedLCA(const Tree<T>* tree, WeightOf _weightOf = WeightOf())
+            : LCA<T>(tree), weightOf(_weightOf) {
+            const size_t size = (this -> E.size() + 1) / 2;
+            prefixWeights.resize(this -> nodes.capacity());
+
+            std::vector<WeightedEdge> edges;
+            edges.reserve(size - 1);
+
+            // Walks the Euler tour keeping the root path: stepping back to the node below
+            // the top of the path is an ascent, anything else descends into a new node.
+            std::vector<WeightedPathEntry> path;
+            uint32_t preorder = 0;
+
+            for(size_t i = 0; i < this -> E.size(); i++) {
+                const Tree<T>* node = this -> eulerNode(i);
+
+                if(path.empty()) {
+                    path.push_back(WeightedPathEntry(node, preorder++, Weight()));
+                } else if(path.size() >= 2 && path[path.size() - 2].node == node) {
+                    path.pop_back();
+                    continue;
+                } else {
+                    const Weight weight = weightOf(node -> root());
+                    edges.push_back(WeightedEdge(path.back().preorder, preorder, weight));
+                    path.push_back(WeightedPathEntry(node, preorder++, path.back().prefixWeight + weight));
+                }
+
+                prefixWeights[this -> E[i]] = path.back().prefixWeight;
+            }
+
+            std::sort(edges.begin(), edges.end(), LighterEdge());
+            maxEdgeTree = KruskalTree(size, edges.begin(), edges.end());
+            minEdgeTree = KruskalTree(size, edges.rbegin(), edges.rend());
+        }
+
+        // Sum of the edge weights on the path between u and v.
+        Weight weightedDistance(const Tree<T>* u, const Tree<T>* v) const {
+            const size_t indexU = this -> requireEdgeIndex(u, v);
+            const size_t indexV = this -> requireEdgeIndex(v, u);
+            const size_t indexLCA = this -> RMQ.getRMQ(indexU, indexV);
+
+            return prefixWeights[this -> E[indexU]] + prefixWeights[this -> E[indexV]]
+                - prefixWeights[this -> E[indexLCA]] - prefixWeights[this -> E[indexLCA]];
+        }
+
+        // Heaviest edge on the path between u and v.
+        Weight maxEdgeOnPath(const Tree<T>* u, const Tree<T>* v) const {
+            return maxEdgeTree.bottleneck(preorderOf(u, v), preorderOf(v, u));
+        }
+
+        // Lightest edge on the path between u and v.
+        Weight minEdgeOnPath(const Tree<T>* u, const Tree<T>* v) const {
+            return minEdgeTree.bottleneck(preorderOf(u, v), preorderOf(v, u));
+        }
+
+        size_t memoryUsage() const {
+            return LCA<T>::memoryUsage()
+                + prefixWeights.capacity() * sizeof(Weight)
+                + maxEdgeTree.memoryUsage()
+                + minEdgeTree.memoryUsage();
+        }
+
+    private:
+        struct WeightedPathEntry {
+            const Tree<T>* node;
+            uint32_t preorder;
+            Weight prefixWeight;
+
+            WeightedPathEntry(const Tree<T>* _node, uint32_t _preorder, const Weight& _prefixWeight)
+                : node(_node), preorder(_preorder), prefixWeight(_prefixWeight) {}
+        };
+
+        struct WeightedEdge {
+            uint32_t parent;
+            uint32_t child;
+            Weight weight;
+
+            WeightedEdge(uint32_t _parent, uint32_t _child, const Weight& _weight)
+                : parent(_parent), child(_child), weight(_weight) {}
+        };
+
+        struct LighterEdge {
+            bool operator()(const WeightedEdge& a, const WeightedEdge& b) const {
+                return a.weight < b.weight;
+            }
+        };
+
+        // Kruskal reconstruction tree: merging the components of the tree's edges in the
+        // given order creates one internal node per edge, holding its weight. The last edge
+        // merged on the path between two nodes is their LCA here, so path bottlenecks are
+        // answered by the same Euler tour + PlusMinusOneRMQ scheme as LCA.
+        //
+        // Every internal node has two children, so between two leaves the tour passes their
+        // LCA exactly once: on its middle visit, back from its left child. Weights are kept
+        // in the order of middle visits and found by counting the middle visits before the
+        // range minimum.
+        class KruskalTree {
+            public:
+                KruskalTree() : leaves(0), position(0) {}
+
+                template<typename EdgeIterator>
+                KruskalTree(size_t _leaves, EdgeIterator first, EdgeIterator last) : leaves(_leaves), position(0) {
+                    const size_t internal = leaves - 1;
+                    std::vector<Weight> mergeWeights;
+                    std::vector<uint32_t> left, right;
+                    mergeWeights.reserve(internal);
+                    left.reserve(internal);
+                    right.reserve(internal);
+
+                    std::vector<uint32_t> component(leaves), top(leaves);
+                    for(size_t i = 0; i < leaves; i++) {
+                        component[i] = i;
+                        top[i] = i;
+                    }
+
+                    for(EdgeIterator edge = first; edge != last; ++edge) {
+                        const uint32_t a = find(component, edge -> parent);
+                        const uint32_t b = find(component, edge -> child);
+
+                        left.push_back(top[a]);
+                        right.push_back(top[b]);
+                        mergeWeights.push_back(edge -> weight);
+
+                        component[b] = a;
+                        top[a] = leaves + mergeWeights.size() - 1;
+                    }
+
+                    const size_t eulerSize = 2 * (leaves + internal) - 1;
+                    RMQ = PlusMinusOneRMQ(eulerSize, 1, true);
+                    leafIndex.resize(leaves);
+                    weights.reserve(internal);
+                    middleVisits.resize((eulerSize + 63) / 64);
+
+                    // Iterative Euler tour: the tree can be as deep as it has edges.
+                    std::vector<std::pair<uint32_t, uint32_t>> stack;
+                    stack.push_back(std::make_pair(top[find(component, 0)], uint32_t(0)));
+                    visit(stack.back().first, 0);
+
+                    while(!stack.empty()) {
+                        std::pair<uint32_t, uint32_t>& current = stack.back();
+
+                        if(current.first < leaves || current.second == 2) {
+                            stack.pop_back();
+                            if(!stack.empty()) {
+                                if(stack.back().second == 1) {
+                                    middleVisits[position / 64] |= 1ULL << (position % 64);
+                                    weights.push_back(mergeWeights[stack.back().first - leaves]);
+                                }
+                                visit(stack.back().first, stack.size() - 1);
+                            }
+                            continue;
+                        }
+
+                        const size_t internalIndex = current.first - leaves;
+                        const uint32_t child = current.second == 0 ? left[internalIndex] : right[internalIndex];
+                        current.second++;
+
+                        stack.push_back(std::make_pair(child, uint32_t(0)));
+                        visit(child, stack.size() - 1);
+                    }
+
+                    RMQ.finish();
+
+                    middleVisitsBefore.resize(middleVisits.size());
+                    uint32_t count = 0;
+                    for(size_t word = 0; word < middleVisits.size(); word++) {
+                        middleVisitsBefore[word] = count;
+                        count += __builtin_popcountll(middleVisits[word]);
+                    }
+                }
+
+                Weight bottleneck(size_t u, size_t v) const {
+                    if(u == v) {
+                        throw std::runtime_error("The path between a node and itself has no edges!");
+                    }
+
+                    const size_t index = RMQ.getRMQ(leafIndex[u], leafIndex[v]);
+                    const uint64_t earlier = middleVisits[index / 64] & ((1ULL << (index % 64)) - 1);
+
+                    return weights[middleVisitsBefore[index / 64] + __builtin_popcountll(earlier)];
+                }
+
+                size_t memoryUsage() const {
+                    return weights.capacity() * sizeof(Weight)
+                        + leafIndex.capacity() * sizeof(uint32_t)
+                        + middleVisits.capacity() * sizeof(uint64_t)
+                        + middleVisitsBefore.capacity() * sizeof(uint32_t)
+                        + RMQ.memoryUsage();
+                }
+
+            private:
+                size_t leaves;
+                // Length of the Euler tour so far, only used while building.
+                size_t position;
+                // Weights of the internal nodes in the order of their middle visits.
+                std::vector<Weight> weights;
+                // Euler index of the only visit of every leaf.
+                std::vector<uint32_t> leafIndex;
+                // Bit i is set when Euler index i is a middle visit.
+                std::vector<uint64_t> middleVisits;
+                // Number of middle visits before every word of middleVisits.
+                std::vector<uint32_t> middleVisitsBefore;
+                PlusMinusOneRMQ RMQ;
+
+                static uint32_t find(std::vector<uint32_t>& component, uint32_t x) {
+                    while(component[x] != x) {
+                        component[x] = component[component[x]];
+                        x = component[x];
+                    }
+                    return x;
+                }
+
+                void visit(size_t node, size_t depth) {
+                    if(node < leaves) {
+                        leafIndex[node] = position;
+                    }
+                    RMQ.push(depth);
+                    position++;
+                }
+        };
+
+        WeightOf weightOf;
+        // Weight of the root path of the node in every slot of nodes.
+        std::vector<Weight> prefixWeights;
+        KruskalTree maxEdgeTree;
+        KruskalTree minEdgeTree;
+
+        // The tour reaches a node after preorder descents and preorder - depth ascents.
+        size_t preorderOf(const Tree<T>* node, const Tree<T>* other) const {
+            const size_t index = this -> requireEdgeIndex(node, other);
+            return (index + this -> RMQ.valueAt(index)) / 2;
+        }
+};
+
+#endif
@@ -0,0 +1,397 @@
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+#include "Tree.hpp"
+#include "LCA.hpp"
+#include "WeightedLCA.hpp"
+#include "JumpPointerLCA.hpp"
+#include "PlusMinusOneRMQ.hpp"
+
+// Случайно диференциално тестване: всички реализации се сравняват с наивен
+// оракул, който се изкачва по родителите. Размерите се управляват от
+// променливите на средата:
+//   LCA_STRESS_MAX_NODES - най-голямото дърво (по подразбиране 200000)
+//   LCA_STRESS_SEED      - начално зърно на генератора
+// Реализациите се строят една по една; пиковата памет е около 320 байта на възел
+// без санитайзери и около 750 байта на възел с ASan/UBSan (при 10^6 възела: 0.32 GB
+// и 0.75 GB). 10^7 възела без санитайзери: 3.1 GB и около 9 минути.
+
+namespace {
+
+size_t environmentOr(const char* name, size_t fallback) {
+    const char* value = std::getenv(name);
+    return value == nullptr ? fallback : std::strtoull(value, nullptr, 10);
+}
+
+const size_t MAX_NODES = environmentOr("LCA_STRESS_MAX_NODES", 200000);
+const size_t SEED = environmentOr("LCA_STRESS_SEED", 20250101);
+const size_t QUERIES_PER_TREE = 2000;
+// Оракулът се изкачва по родителите, затова за дълбоки дървета заявките намаляват
+const size_t ORACLE_STEPS_PER_TREE = 8000000;
+const size_t MIN_QUERIES_PER_TREE = 40;
+
+// Тегло на реброто към родителя, зависещо само от стойността на възела
+struct HashedWeight {
+    long long operator()(const int& value) const {
+        return static_cast<long long>((static_cast<unsigned long long>(value) * 2654435761ULL) % 1000);
+    }
+};
+
+// Избира родител на възел i (0 < i) при вече построени възли [0, i)
+typedef std::function<size_t(size_t i, size_t n, std::mt19937_64& rng)> ParentChooser;
+
+struct Shape {
+    std::string name;
+    ParentChooser parent;
+};
+
+std::vector<Shape> shapes() {
+    return {
+        {"path", [](size_t i, size_t, std::mt19937_64&) { return i - 1; }},
+        {"star", [](size_t, size_t, std::mt19937_64&) { return size_t(0); }},
+        {"binary", [](size_t i, size_t, std::mt19937_64&) { return (i - 1) / 2; }},
+        {"wide", [](size_t i, size_t, std::mt19937_64&) { return (i - 1) / 16; }},
+        {"random", [](size_t i, size_t, std::mt19937_64& rng) { return size_t(rng() % i); }},
+        {"deepRandom", [](size_t i, size_t, std::mt19937_64& rng) { return i - 1 - size_t(rng() % std::min<size_t>(i, 3)); }},
+        {"caterpillar", [](size_t i, size_t n, std::mt19937_64& rng) {
+            const size_t spine = std::max<size_t>(1, n / 2);
+            return i < spine ? i - 1 : size_t(rng() % spine);
+        }},
+        {"broom", [](size_t i, size_t n, std::mt19937_64&) {
+            const size_t handle = std::max<size_t>(1, n / 2);
+            return i < handle ? i - 1 : handle - 1;
+        }},
+    };
+}
+
+// Дърво заедно с масивите на оракула
+struct GeneratedTree {
+    std::vector<Tree<int>*> nodes;
+    std::vector<size_t> parent;
+    std::vector<size_t> depth;
+    size_t maxDepth;
+    size_t deepest;
+
+    GeneratedTree(const Shape& shape, size_t n, std::mt19937_64& rng) : nodes(n), parent(n, 0), depth(n, 0), maxDepth(0), deepest(0) {
+        for (size_t i = 0; i < n; i++) {
+            nodes[i] = new Tree<int>(static_cast<int>(i));
+        }
+
+        for (size_t i = 1; i < n; i++) {
+            const size_t p = shape.parent(i, n, rng);
+            parent[i] = p;
+            depth[i] = depth[p] + 1;
+            if (depth[i] > maxDepth) {
+                maxDepth = depth[i];
+                deepest = i;
+            }
+            nodes[p]->addSubtree(nodes[i]);
+        }
+    }
+
+    ~GeneratedTree() {
+        delete nodes[0];
+    }
+
+    size_t naiveLCA(size_t u, size_t v) const {
+        while (depth[u] > depth[v]) u = parent[u];
+        while (depth[v] > depth[u]) v = parent[v];
+        while (u != v) {
+            u = parent[u];
+            v = parent[v];
+        }
+        return u;
+    }
+
+    size_t naiveAncestor(size_t u, size_t targetDepth) const {
+        while (depth[u] > targetDepth) u = parent[u];
+        return u;
+    }
+
+    // Сума, максимум и минимум на теглата по пътя между u и v
+    void naivePath(size_t u, size_t v, long long& sum, long long& maxWeight, long long& minWeight) const {
+        HashedWeight weightOf;
+        sum = 0;
+        maxWeight = -1;
+        minWeight = -1;
+
+        while (u != v) {
+            if (depth[u] < depth[v]) std::swap(u, v);
+            const long long weight = weightOf(static_cast<int>(u));
+            sum += weight;
+            maxWeight = std::max(maxWeight, weight);
+            minWeight = minWeight < 0 ? weight : std::min(minWeight, weight);
+            u = parent[u];
+        }
+    }
+};
+
+// Размерите за едно пускане: всички малки, после геометрично до MAX_NODES
+std::vector<size_t> treeSizes() {
+    std::vector<size_t> sizes;
+    for (size_t n = 1; n <= std::min<size_t>(64, MAX_NODES); n++) {
+        sizes.push_back(n);
+    }
+    for (size_t n = 100; n < MAX_NODES; n = n * 3 + 7) {
+        sizes.push_back(n);
+    }
+    if (MAX_NODES > 64) {
+        sizes.push_back(MAX_NODES);
+    }
+    return sizes;
+}
+
+// Двойки за проверка: всички за малки дървета, иначе случайни плюс крайни случаи
+std::vector<std::pair<size_t, size_t>> queryPairs(const GeneratedTree& tree, std::mt19937_64& rng) {
+    const size_t n = tree.nodes.size();
+    std::vector<std::pair<size_t, size_t>> pairs;
+
+    if (n * n <= QUERIES_PER_TREE) {
+        for (size_t u = 0; u < n; u++) {
+            for (size_t v = 0; v < n; v++) {
+                pairs.push_back(std::make_pair(u, v));
+            }
+        }
+        return pairs;
+    }
+
+    const size_t queries = std::min(QUERIES_PER_TREE,
+        std::max(MIN_QUERIES_PER_TREE, ORACLE_STEPS_PER_TREE / (tree.maxDepth + 1)));
+
+    for (size_t q = 0; q < queries; q++) {
+        const size_t u = rng() % n;
+        switch (q % 5) {
+            case 0: pairs.push_back(std::make_pair(u, u)); break;
+            case 1: pairs.push_back(std::make_pair(u, tree.parent[u])); break;
+            case 2: pairs.push_back(std::make_pair(n - 1 - rng() % std::min<size_t>(n, 8), u)); break;
+            default: pairs.push_back(std::make_pair(u, size_t(rng() % n))); break;
+        }
+    }
+    return pairs;
+}
+
+// Отговорите на оракула за една заявка, изчислени преди да се построи която и да е реализация
+struct Expected {
+    size_t u, v;
+    size_t lca;
+    size_t ancestorDepth, ancestor;
+    long long sum, maxWeight, minWeight;
+};
+
+// Възел извън дървото трябва да дава изключение и срещу най-дълбокия възел
+template<typename Engine>
+void checkOutsideNode(const Engine& engine, const GeneratedTree& tree) {
+    Tree<int> outside(-1);
+    const Tree<int>* deepest = tree.nodes[tree.deepest];
+
+    ASSERT_THROW(engine.getLCA(deepest, &outside), std::runtime_error);
+    ASSERT_THROW(engine.getLCA(&outside, deepest), std::runtime_error);
+}
+
+void checkLCA(const LCA<int>& lca, const GeneratedTree& tree, const std::vector<Expected>& expected) {
+    ASSERT_NO_FATAL_FAILURE(checkOutsideNode(lca, tree));
+
+    Tree<int> outside(-1);
+    const std::vector<std::pair<const Tree<int>*, const Tree<int>*>> withOutside = {
+        std::make_pair(tree.nodes[tree.deepest], tree.nodes[0]),
+        std::make_pair(tree.nodes[tree.deepest], static_cast<const Tree<int>*>(&outside))
+    };
+    ASSERT_THROW(lca.getLCAs(withOutside), std::runtime_error);
+
+    std::vector<std::pair<const Tree<int>*, const Tree<int>*>> batch;
+    for (const Expected& e : expected) {
+        batch.push_back(std::make_pair(tree.nodes[e.u], tree.nodes[e.v]));
+    }
+    const std::vector<const Tree<int>*> batchResults = lca.getLCAs(batch);
+
+    for (size_t q = 0; q < expected.size(); q++) {
+        const Expected& e = expected[q];
+        SCOPED_TRACE("query (" + std::to_string(e.u) + ", " + std::to_string(e.v) + ")");
+        ASSERT_EQ(lca.getLCA(tree.nodes[e.u], tree.nodes[e.v]), tree.nodes[e.lca]);
+        ASSERT_EQ(batchResults[q], tree.nodes[e.lca]);
+    }
+}
+
+void checkWeightedLCA(const WeightedLCA<int, HashedWeight>& weighted, const GeneratedTree& tree, const std::vector<Expected>& expected) {
+    ASSERT_NO_FATAL_FAILURE(checkLCA(weighted, tree, expected));
+
+    for (const Expected& e : expected) {
+        SCOPED_TRACE("query (" + std::to_string(e.u) + ", " + std::to_string(e.v) + ")");
+        ASSERT_EQ(weighted.weightedDistance(tree.nodes[e.u], tree.nodes[e.v]), e.sum);
+        if (e.u != e.v) {
+            ASSERT_EQ(weighted.maxEdgeOnPath(tree.nodes[e.u], tree.nodes[e.v]), e.maxWeight);
+            ASSERT_EQ(weighted.minEdgeOnPath(tree.nodes[e.u], tree.nodes[e.v]), e.minWeight);
+        }
+    }
+}
+
+void checkJumpPointerLCA(const JumpPointerLCA<int>& jumpPointer, const GeneratedTree& tree, const std::vector<Expected>& expected) {
+    ASSERT_NO_FATAL_FAILURE(checkOutsideNode(jumpPointer, tree));
+
+    for (const Expected& e : expected) {
+        SCOPED_TRACE("query (" + std::to_string(e.u) + ", " + std::to_string(e.v) + ")");
+        ASSERT_EQ(jumpPointer.getLCA(tree.nodes[e.u], tree.nodes[e.v]), tree.nodes[e.lca]);
+        ASSERT_EQ(jumpPointer.getDepth(tree.nodes[e.u]), tree.depth[e.u]);
+        ASSERT_EQ(jumpPointer.getLevelAncestor(tree.nodes[e.u], e.ancestorDepth), tree.nodes[e.ancestor]);
+    }
+}
+
+// Реализациите се строят една по една, за да не се събират индексите им в паметта
+void checkEngines(const Shape& shape, size_t n, std::mt19937_64& rng) {
+    SCOPED_TRACE("shape " + shape.name + ", " + std::to_string(n) + " nodes");
+
+    GeneratedTree tree(shape, n, rng);
+    const std::vector<std::pair<size_t, size_t>> pairs = queryPairs(tree, rng);
+
+    std::vector<Expected> expected(pairs.size());
+    for (size_t q = 0; q < pairs.size(); q++) {
+        Expected& e = expected[q];
+        e.u = pairs[q].first;
+        e.v = pairs[q].second;
+        e.lca = tree.naiveLCA(e.u, e.v);
+        e.ancestorDepth = tree.depth[e.v] % (tree.depth[e.u] + 1);
+        e.ancestor = tree.naiveAncestor(e.u, e.ancestorDepth);
+        tree.naivePath(e.u, e.v, e.sum, e.maxWeight, e.minWeight);
+    }
+
+    {
+        SCOPED_TRACE("full LCA");
+        LCA<int> full(tree.nodes[0]);
+        ASSERT_NO_FATAL_FAILURE(checkLCA(full, tree, expected));
+    }
+    {
+        SCOPED_TRACE("compact LCA");
+        LCA<int> compact(tree.nodes[0], LCA<int>::estimatePeakMemoryUsage(n, tree.maxDepth, 1, true));
+        ASSERT_NO_FATAL_FAILURE(checkLCA(compact, tree, expected));
+    }
+    {
+        SCOPED_TRACE("sampled LCA");
+        LCA<int> sampled(tree.nodes[0], LCA<int>::estimatePeakMemoryUsage(n, tree.maxDepth, 4, true));
+        ASSERT_NO_FATAL_FAILURE(checkLCA(sampled, tree, expected));
+    }
+    {
+        SCOPED_TRACE("WeightedLCA");
+        WeightedLCA<int, HashedWeight> weighted(tree.nodes[0]);
+        ASSERT_NO_FATAL_FAILURE(checkWeightedLCA(weighted, tree, expected));
+    }
+    {
+        SCOPED_TRACE("JumpPointerLCA");
+        JumpPointerLCA<int> jumpPointer(tree.nodes[0]);
+        ASSERT_NO_FATAL_FAILURE(checkJumpPointerLCA(jumpPointer, tree, expected));
+    }
+}
+
+// Случайна ±1 редица с начало достатъчно високо, за да не стане отрицателна
+std::vector<size_t> plusMinusOneSequence(size_t n, std::mt19937_64& rng) {
+    std::vector<size_t> values(n);
+    values[0] = n;
+    for (size_t i = 1; i < n; i++) {
+        values[i] = (rng() & 1) ? values[i - 1] + 1 : values[i - 1] - 1;
+    }
+    return values;
+}
+
+}
+
+// Всички интервали на всички дължини до 100 и около степените на двойката:
+// покриват заявки в един блок, в съседни блокове и в последния, непълен блок
+TEST(PlusMinusOneRMQStressTest, AllRangesOfShortSequences) {
+    std::mt19937_64 rng(SEED);
+
+    std::vector<size_t> lengths;
+    for (size_t n = 1; n <= 100; n++) {
+        lengths.push_back(n);
+    }
+    for (size_t power = 128; power <= 512; power *= 2) {
+        lengths.push_back(power - 1);
+        lengths.push_back(power);
+        lengths.push_back(power + 1);
+    }
+
+    for (size_t n : lengths) {
+        const std::vector<size_t> values = plusMinusOneSequence(n, rng);
+
+        for (size_t superblock = 1; superblock <= 4; superblock++) {
+            for (int compact = 0; compact <= 1; compact++) {
+                SCOPED_TRACE("n " + std::to_string(n) + ", superblock " + std::to_string(superblock)
+                    + ", compact " + std::to_string(compact));
+                PlusMinusOneRMQ rmq(values, superblock, compact == 1);
+
+                std::vector<std::pair<size_t, size_t>> ranges;
+                for (size_t i = 0; i < n; i++) {
+                    size_t minimum = values[i];
+                    for (size_t j = i; j < n; j++) {
+                        minimum = std::min(minimum, values[j]);
+
+                        const size_t forward = rmq.getRMQ(i, j);
+                        const size_t backward = rmq.getRMQ(j, i);
+                        ASSERT_TRUE(i <= forward && forward <= j) << i << " " << j;
+                        ASSERT_EQ(values[forward], minimum) << i << " " << j;
+                        ASSERT_EQ(backward, forward) << i << " " << j;
+                        ASSERT_EQ(rmq.valueAt(forward), minimum) << i << " " << j;
+
+                        ranges.push_back(std::make_pair(j, i));
+                    }
+                }
+
+                std::vector<size_t> results;
+                rmq.getRMQs(ranges, results);
+                ASSERT_EQ(results.size(), ranges.size());
+                for (size_t q = 0; q < ranges.size(); q++) {
+                    ASSERT_EQ(results[q], rmq.getRMQ(ranges[q].first, ranges[q].second));
+                }
+            }
+        }
+    }
+}
+
+TEST(PlusMinusOneRMQStressTest, RandomRangesOfLongSequences) {
+    std::mt19937_64 rng(SEED + 1);
+
+    for (size_t n = 1000; n <= MAX_NODES; n *= 10) {
+        const std::vector<size_t> values = plusMinusOneSequence(n, rng);
+
+        for (size_t superblock = 1; superblock <= 8; superblock *= 8) {
+            SCOPED_TRACE("n " + std::to_string(n) + ", superblock " + std::to_string(superblock));
+            PlusMinusOneRMQ rmq(values, superblock, superblock != 1);
+
+            // От случайни начала се разширява надясно, като минимумът се поддържа наготово
+            for (size_t start = 0; start < 20; start++) {
+                const size_t i = start == 0 ? 0 : rng() % n;
+                size_t minimum = values[i];
+                size_t j = i;
+
+                while (true) {
+                    ASSERT_EQ(values[rmq.getRMQ(i, j)], minimum) << i << " " << j;
+                    if (j == n - 1) {
+                        break;
+                    }
+
+                    const size_t next = std::min(n - 1, j + 1 + size_t(rng() % 97));
+                    for (j++; j <= next; j++) {
+                        minimum = std::min(minimum, values[j]);
+                    }
+                    j = next;
+                }
+            }
+        }
+    }
+}
+
+TEST(LCAStressTest, AllShapesAgainstNaiveOracle) {
+    std::mt19937_64 rng(SEED + 2);
+    const std::vector<size_t> sizes = treeSizes();
+
+    for (const Shape& shape : shapes()) {
+        for (size_t n : sizes) {
+            checkEngines(shape, n, rng);
+            if (HasFatalFailure()) {
+                return;
+            }
+        }
+    }
+}
@@ -1,6 +1,9 @@
 #include <gtest/gtest.h>
 #include "Tree.hpp"
 #include "LCA.hpp"
+#include "WeightedLCA.hpp"
+#include "JumpPointerLCA.hpp"
+#include <random>
 
 // Test Fixture за дървото
 class TreeTest : public ::testing::Test {
@@ -281,6 +284,307 @@ TEST_F(LCATest, AllPossiblePairs) {
     }
 }
 
+// Пакетните заявки трябва да връщат същото като getLCA
+TEST_F(LCATest, BatchedLCAsMatchSingleQueries) {
+    std::vector<Tree<std::string>*> all_nodes = {root, b, c, d, e, f, g, h};
+    std::vector<std::pair<const Tree<std::string>*, const Tree<std::string>*>> queries;
+
+    for (size_t i = 0; i < all_nodes.size(); i++) {
+        for (size_t j = 0; j < all_nodes.size(); j++) {
+            queries.push_back(std::make_pair(all_nodes[i], all_nodes[j]));
+        }
+    }
+
+    std::vector<const Tree<std::string>*> results = lca->getLCAs(queries);
+
+    ASSERT_EQ(results.size(), queries.size());
+    for (size_t q = 0; q < queries.size(); q++) {
+        EXPECT_EQ(results[q], lca->getLCA(queries[q].first, queries[q].second));
+    }
+}
+
+TEST_F(LCATest, BatchedLCAsInvalidInput) {
+    Tree<std::string>* outsideNode = new Tree<std::string>("outside");
+
+    std::vector<std::pair<const Tree<std::string>*, const Tree<std::string>*>> withNull = {{c, f}, {nullptr, c}};
+    std::vector<std::pair<const Tree<std::string>*, const Tree<std::string>*>> withOutside = {{c, f}, {c, outsideNode}};
+
+    EXPECT_THROW(lca->getLCAs(withNull), std::runtime_error);
+    EXPECT_THROW(lca->getLCAs(withOutside), std::runtime_error);
+    EXPECT_TRUE(lca->getLCAs({}).empty());
+
+    delete outsideNode;
+}
+
+// Компактният режим трябва да дава същите отговори при всеки бюджет
+TEST(LCAMemoryBudgetTest, CompactModesMatchFullIndex) {
+    // Дърво с 2000 възела: верига с по едно листо на всеки възел
+    std::vector<Tree<int>*> nodes;
+    Tree<int>* root = new Tree<int>(0);
+    nodes.push_back(root);
+    Tree<int>* spine = root;
+    for (int i = 1; i < 1000; i++) {
+        Tree<int>* leaf = new Tree<int>(2 * i);
+        Tree<int>* next = new Tree<int>(2 * i + 1);
+        spine->addSubtree(leaf);
+        spine->addSubtree(next);
+        nodes.push_back(leaf);
+        nodes.push_back(next);
+        spine = next;
+    }
+
+    LCA<int> full(root);
+    EXPECT_FALSE(full.isCompact());
+    EXPECT_EQ(full.superblockSize(), 1);
+
+    size_t previousUsage = full.memoryUsage();
+    size_t budget = LCA<int>::estimatePeakMemoryUsage(nodes.size(), 999, 1, true);
+    for (int step = 0; step < 4; step++) {
+        LCA<int> compact(root, budget);
+        EXPECT_TRUE(compact.isCompact());
+        EXPECT_LE(LCA<int>::estimatePeakMemoryUsage(nodes.size(), 999, compact.superblockSize(), true), budget);
+        EXPECT_EQ(compact.memoryUsage(), LCA<int>::estimateMemoryUsage(nodes.size(), compact.superblockSize(), true));
+        EXPECT_LT(compact.memoryUsage(), previousUsage);
+        previousUsage = compact.memoryUsage();
+
+        for (size_t i = 0; i < nodes.size(); i += 7) {
+            for (size_t j = 0; j < nodes.size(); j += 13) {
+                EXPECT_EQ(compact.getLCA(nodes[i], nodes[j]), full.getLCA(nodes[i], nodes[j]));
+            }
+        }
+
+        budget = LCA<int>::estimatePeakMemoryUsage(nodes.size(), 999, compact.superblockSize(), true) - 1;
+    }
+
+    delete root;
+}
+
+// Най-компактният индекс трябва да е под 30 байта на възел
+TEST(LCAMemoryBudgetTest, CompactModeBelowThirtyBytesPerNode) {
+    const size_t size = 100000;
+    std::vector<Tree<int>*> nodes;
+    Tree<int>* root = new Tree<int>(0);
+    nodes.push_back(root);
+    std::mt19937 rng(42);
+    for (size_t i = 1; i < size; i++) {
+        Tree<int>* node = new Tree<int>(i);
+        nodes[rng() % i]->addSubtree(node);
+        nodes.push_back(node);
+    }
+
+    LCA<int> full(root);
+    LCA<int> compact(root, 30 * size);
+    EXPECT_TRUE(compact.isCompact());
+    EXPECT_LE(compact.memoryUsage(), 30 * size);
+    EXPECT_LT(compact.memoryUsage(), full.memoryUsage());
+
+    for (size_t i = 0; i < size; i += 997) {
+        for (size_t j = 1; j < size; j += 1499) {
+            EXPECT_EQ(compact.getLCA(nodes[i], nodes[j]), full.getLCA(nodes[i], nodes[j]));
+        }
+    }
+
+    delete root;
+}
+
+TEST(LCAMemoryBudgetTest, BudgetTooSmall) {
+    Tree<int>* root = new Tree<int>(1);
+    root->addSubtree(new Tree<int>(2));
+
+    EXPECT_THROW(LCA<int>(root, 1), std::runtime_error);
+
+    delete root;
+}
+
+// =================== ТЕСТОВЕ ЗА WEIGHTEDLCA КЛАС ===================
+
+// Възел с тегло на реброто към родителя
+struct WeightedNode {
+    std::string name;
+    int edgeWeight;
+
+    int weight() const {
+        return edgeWeight;
+    }
+
+    friend std::ostream& operator<<(std::ostream& os, const WeightedNode& node) {
+        return os << node.name;
+    }
+};
+
+class WeightedLCATest : public ::testing::Test {
+protected:
+    void SetUp() override {
+        // Структура (теглата са на реброто към родителя):
+        //          a
+        //       3/   \2
+        //       b     e
+        //     1/ \7    \5
+        //     c   d     f
+
+        root = new Tree<WeightedNode>({"a", 0});
+        b = new Tree<WeightedNode>({"b", 3});
+        c = new Tree<WeightedNode>({"c", 1});
+        d = new Tree<WeightedNode>({"d", 7});
+        e = new Tree<WeightedNode>({"e", 2});
+        f = new Tree<WeightedNode>({"f", 5});
+
+        b->addSubtree(c);
+        b->addSubtree(d);
+        e->addSubtree(f);
+        root->addSubtree(b);
+        root->addSubtree(e);
+
+        lca = new WeightedLCA<WeightedNode>(root);
+    }
+
+    void TearDown() override {
+        delete lca;
+        delete root;
+    }
+
+    Tree<WeightedNode>* root;
+    Tree<WeightedNode>* b;
+    Tree<WeightedNode>* c;
+    Tree<WeightedNode>* d;
+    Tree<WeightedNode>* e;
+    Tree<WeightedNode>* f;
+    WeightedLCA<WeightedNode>* lca;
+};
+
+TEST_F(WeightedLCATest, LCAStillWorks) {
+    EXPECT_EQ(lca->getLCA(c, d), b);
+    EXPECT_EQ(lca->getLCA(c, f), root);
+    EXPECT_EQ(lca->getLCA(e, f), e);
+}
+
+TEST_F(WeightedLCATest, WeightedDistance) {
+    EXPECT_EQ(lca->weightedDistance(c, d), 8);
+    EXPECT_EQ(lca->weightedDistance(c, f), 11);   // 1 + 3 + 2 + 5
+    EXPECT_EQ(lca->weightedDistance(root, f), 7);
+    EXPECT_EQ(lca->weightedDistance(f, root), 7);
+    EXPECT_EQ(lca->weightedDistance(d, d), 0);
+}
+
+TEST_F(WeightedLCATest, PathBottlenecks) {
+    EXPECT_EQ(lca->maxEdgeOnPath(c, f), 5);
+    EXPECT_EQ(lca->minEdgeOnPath(c, f), 1);
+    EXPECT_EQ(lca->maxEdgeOnPath(c, d), 7);
+    EXPECT_EQ(lca->minEdgeOnPath(c, d), 1);
+    EXPECT_EQ(lca->maxEdgeOnPath(root, d), 7);
+    EXPECT_EQ(lca->minEdgeOnPath(root, d), 3);
+    EXPECT_EQ(lca->minEdgeOnPath(f, root), 2);
+    EXPECT_EQ(lca->maxEdgeOnPath(e, f), 5);
+}
+
+TEST_F(WeightedLCATest, InvalidInput) {
+    Tree<WeightedNode>* outsideNode = new Tree<WeightedNode>({"outside", 1});
+
+    EXPECT_THROW(lca->weightedDistance(nullptr, c), std::runtime_error);
+    EXPECT_THROW(lca->maxEdgeOnPath(c, outsideNode), std::runtime_error);
+    EXPECT_THROW(lca->minEdgeOnPath(c, c), std::runtime_error);
+
+    delete outsideNode;
+}
+
+TEST(WeightedLCACustomAccessorTest, DepthAsWeight) {
+    // Тегло, зададено чрез функтор вместо член weight()
+    struct DoubleValue {
+        double operator()(const int& value) const {
+            return value * 0.5;
+        }
+    };
+
+    Tree<int>* root = new Tree<int>(0);
+    Tree<int>* child = new Tree<int>(4);
+    Tree<int>* grandchild = new Tree<int>(6);
+    child->addSubtree(grandchild);
+    root->addSubtree(child);
+
+    WeightedLCA<int, DoubleValue> lca(root);
+
+    EXPECT_DOUBLE_EQ(lca.weightedDistance(root, grandchild), 5.0);
+    EXPECT_DOUBLE_EQ(lca.maxEdgeOnPath(root, grandchild), 3.0);
+    EXPECT_DOUBLE_EQ(lca.minEdgeOnPath(root, grandchild), 2.0);
+
+    delete root;
+}
+
+// =================== ТЕСТОВЕ ЗА JUMPPOINTERLCA КЛАС ===================
+
+class JumpPointerLCATest : public TreeTest {
+protected:
+    void SetUp() override {
+        TreeTest::SetUp();
+        lca = new JumpPointerLCA<std::string>(root);
+    }
+
+    void TearDown() override {
+        delete lca;
+        TreeTest::TearDown();
+    }
+
+    JumpPointerLCA<std::string>* lca;
+};
+
+TEST_F(JumpPointerLCATest, AllPossiblePairsMatchEulerLCA) {
+    std::vector<Tree<std::string>*> all_nodes = {root, b, c, d, e, f, g, h};
+    LCA<std::string> euler(root);
+
+    for (size_t i = 0; i < all_nodes.size(); i++) {
+        for (size_t j = 0; j < all_nodes.size(); j++) {
+            EXPECT_EQ(lca->getLCA(all_nodes[i], all_nodes[j]), euler.getLCA(all_nodes[i], all_nodes[j]));
+        }
+    }
+}
+
+TEST_F(JumpPointerLCATest, DepthAndLevelAncestor) {
+    EXPECT_EQ(lca->getDepth(root), 0);
+    EXPECT_EQ(lca->getDepth(d), 2);
+    EXPECT_EQ(lca->getDepth(h), 3);
+
+    EXPECT_EQ(lca->getLevelAncestor(h, 0), root);
+    EXPECT_EQ(lca->getLevelAncestor(h, 1), b);
+    EXPECT_EQ(lca->getLevelAncestor(h, 2), d);
+    EXPECT_EQ(lca->getLevelAncestor(h, 3), h);
+    EXPECT_EQ(lca->getLevelAncestor(g, 1), e);
+    EXPECT_THROW(lca->getLevelAncestor(e, 2), std::runtime_error);
+}
+
+TEST_F(JumpPointerLCATest, InvalidInput) {
+    Tree<std::string>* outsideNode = new Tree<std::string>("outside");
+
+    EXPECT_THROW(lca->getLCA(nullptr, c), std::runtime_error);
+    EXPECT_THROW(lca->getLCA(b, nullptr), std::runtime_error);
+    EXPECT_THROW(lca->getLCA(outsideNode, c), std::runtime_error);
+    EXPECT_THROW(lca->getDepth(outsideNode), std::runtime_error);
+
+    delete outsideNode;
+}
+
+TEST(JumpPointerLCADeepTreeTest, LongPath) {
+    // Верига от 1000 възела: скоковете трябва да стигат до корена за O(log n)
+    std::vector<Tree<int>*> nodes;
+    nodes.push_back(new Tree<int>(0));
+    for (int i = 1; i < 1000; i++) {
+        nodes.push_back(new Tree<int>(i));
+        nodes[i - 1]->addSubtree(nodes[i]);
+    }
+
+    JumpPointerLCA<int> lca(nodes[0]);
+
+    EXPECT_EQ(lca.getLCA(nodes[999], nodes[500]), nodes[500]);
+    EXPECT_EQ(lca.getLCA(nodes[3], nodes[998]), nodes[3]);
+    EXPECT_EQ(lca.getLevelAncestor(nodes[999], 1), nodes[1]);
+    EXPECT_EQ(lca.getDepth(nodes[999]), 999);
+
+    // По 12 байта на слот за връзките плюс 8 за указателя в индекса
+    EXPECT_LT(lca.memoryUsage(), LCA<int>(nodes[0]).memoryUsage());
+    EXPECT_LE(lca.memoryUsage(), 26 * nodes.size());
+
+    delete nodes[0];
+}
+
 // Edge case: много дълбоко дърво
 TEST(LCADeepTreeTest, DeepTree) {
     // Създаваме верижно дърво: a -> b -> c -> d -> e